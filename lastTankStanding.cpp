@@ -21,6 +21,7 @@
 */
 
 #include <algorithm>
+#include <cstdio>
 #include <memory>
 #include <time.h>
 #include <vector>
@@ -34,10 +35,22 @@ std::string PLUGIN_NAME = "Last Tank Standing";
 
 // Define plugin version numbering
 int MAJOR = 1;
-int MINOR = 1;
-int REV = 1;
+int MINOR = 2;
+int REV = 0;
 int BUILD = 82;
 
+// The number of player slots a server may have
+const int MAX_PLAYER_SLOTS = 256;
+
+// The longest window, in seconds, of tank positions kept when checking if a player is camping
+const int MAX_CAMP_TIME = 60;
+
+// The number of seconds a player has to start moving after being warned for camping
+const int CAMP_WARNING_TIME = 10;
+
+// The number of bytes preallocated for the score timeline of a match
+const int TIMELINE_BUFFER_SIZE = 16384;
+
 // A function that will reset the score for a specific player
 void resetPlayerScore(int playerID)
 {
@@ -61,7 +74,7 @@ int getLastTankStanding()
     // Loop through all of the players in the list
     for (unsigned int i = 0; i < playerList->size(); i++)
     {
-        if (bz_getPlayerByIndex(playerList->get(i))->team != eObservers)
+        if (bz_getPlayerTeam(playerList->get(i)) != eObservers)
         {
             lastTankStanding = playerList->get(i);
         }
@@ -76,7 +89,7 @@ int getPlayerWithLowestScore()
     int lowestPlayerScore = 99999;
     bool foundDuplicate = false;
 
-    std::shared_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
+    std::unique_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
 
     for (unsigned int i = 0; i < playerList->size(); i++) // Loop through all the players
     {
@@ -110,12 +123,330 @@ int getPlayerWithLowestScore()
     return playerWithLowestScore;
 }
 
+// Build a list of all of the players who are still playing (i.e. not observers)
+void getAlivePlayers(bz_APIIntList *alivePlayers)
+{
+    std::unique_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
+
+    for (unsigned int i = 0; i < playerList->size(); i++)
+    {
+        if (bz_getPlayerTeam(playerList->get(i)) != eObservers)
+        {
+            alivePlayers->push_back(playerList->get(i));
+        }
+    }
+}
+
 // Convert a string representation of a boolean to a boolean
 static bool toBool (std::string str)
 {
     return !str.empty() && (strcasecmp(str.c_str (), "true") == 0 || atoi(str.c_str ()) != 0);
 }
 
+// A compact record of every player's net score and whether they're still alive throughout a match. Each sample only stores
+// the slots that changed since the previous sample and stores scores as the difference from the previous score. A slot's
+// state only ever moves forward (not playing, alive, eliminated), so a change only needs one bit to say it moved. The
+// samples are kept in a preallocated ring buffer; when it's full, the oldest samples are folded into a base snapshot.
+class ScoreTimeline
+{
+public:
+    enum SlotState
+    {
+        eNotPlaying = 0, // The slot is not part of the match
+        eAlive = 1,      // The player is still playing in the match
+        eEliminated = 2  // The player has been eliminated from the match
+    };
+
+    ScoreTimeline();
+
+    void reset (void);
+    void sample (int elapsedTime);
+    bool save (const std::string &fileName);
+
+private:
+    void pushVarint (unsigned int value);
+    unsigned int readVarint (size_t &position);
+    void evictOldest (void);
+    void decodeChange (size_t &position, int &slot, bool &advanced, int &delta);
+
+    std::vector<unsigned char>
+        buffer,                                   // The ring buffer of encoded samples
+        record;                                   // The sample currently being encoded before it's copied into the buffer
+
+    size_t
+        head,                                     // The position in the buffer the next sample will be written to
+        tail,                                     // The position in the buffer of the oldest sample
+        used;                                     // The number of bytes of the buffer in use
+
+    int
+        evictedSamples;                           // The number of samples folded into the base snapshot this match
+
+    int
+        currentScore[MAX_PLAYER_SLOTS],           // The score of each slot as of the newest sample
+        baseScore[MAX_PLAYER_SLOTS];              // The score of each slot before the oldest sample in the buffer
+
+    unsigned char
+        currentState[MAX_PLAYER_SLOTS],           // The state of each slot as of the newest sample
+        baseState[MAX_PLAYER_SLOTS];              // The state of each slot before the oldest sample in the buffer
+
+    std::string
+        callsigns[MAX_PLAYER_SLOTS];              // The callsign of each player when they were first sampled
+};
+
+ScoreTimeline::ScoreTimeline() :
+    buffer(TIMELINE_BUFFER_SIZE),
+    record()
+{
+    // The largest possible sample is the elapsed time and change count followed by a change for every slot
+    record.reserve(10 + MAX_PLAYER_SLOTS * 6);
+
+    reset();
+}
+
+void ScoreTimeline::reset()
+{
+    head = tail = used = 0;
+    evictedSamples = 0;
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        currentScore[i] = baseScore[i] = 0;
+        currentState[i] = baseState[i] = eNotPlaying;
+        callsigns[i].clear();
+    }
+}
+
+// Record the score and state of every player that has changed since the previous sample
+void ScoreTimeline::sample(int elapsedTime)
+{
+    int score[MAX_PLAYER_SLOTS];
+    unsigned char state[MAX_PLAYER_SLOTS];
+
+    // Anyone who was alive and is no longer playing has been eliminated, their score stays what it was
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        score[i] = currentScore[i];
+        state[i] = (currentState[i] == eAlive) ? (unsigned char)eEliminated : currentState[i];
+    }
+
+    std::unique_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
+
+    for (unsigned int i = 0; i < playerList->size(); i++)
+    {
+        int playerID = playerList->get(i);
+
+        if (playerID < 0 || playerID >= MAX_PLAYER_SLOTS || bz_getPlayerTeam(playerID) == eObservers)
+        {
+            continue;
+        }
+
+        // Eliminated players stay eliminated even if they find their way back onto a team
+        if (currentState[playerID] == eEliminated)
+        {
+            continue;
+        }
+
+        if (currentState[playerID] == eNotPlaying)
+        {
+            const char* callsign = bz_getPlayerCallsign(playerID);
+            callsigns[playerID] = (callsign) ? callsign : "";
+        }
+
+        score[playerID] = bz_getPlayerWins(playerID) - bz_getPlayerLosses(playerID);
+        state[playerID] = eAlive;
+    }
+
+    unsigned int changes = 0;
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        if (score[i] != currentScore[i] || state[i] != currentState[i])
+        {
+            changes++;
+        }
+    }
+
+    record.clear();
+    pushVarint(elapsedTime);
+    pushVarint(changes);
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        if (score[i] == currentScore[i] && state[i] == currentState[i])
+        {
+            continue;
+        }
+
+        // Zigzag encode the difference so small negative changes stay small and use the lowest bit for a state change
+        int delta = score[i] - currentScore[i];
+        unsigned int zigzag = ((unsigned int)delta << 1) ^ (unsigned int)(delta >> 31);
+
+        record.push_back((unsigned char)i);
+        pushVarint((zigzag << 1) | (state[i] != currentState[i]));
+
+        currentScore[i] = score[i];
+        currentState[i] = state[i];
+    }
+
+    // Make room for the new sample by folding the oldest samples into the base snapshot
+    while (buffer.size() - used < record.size())
+    {
+        evictOldest();
+    }
+
+    for (size_t i = 0; i < record.size(); i++)
+    {
+        buffer[(head + i) % buffer.size()] = record[i];
+    }
+
+    head = (head + record.size()) % buffer.size();
+    used += record.size();
+}
+
+// Write the timeline as text with one line for each sample
+bool ScoreTimeline::save(const std::string &fileName)
+{
+    FILE *file = fopen(fileName.c_str(), "w");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    fprintf(file, "# Last Tank Standing score timeline\n");
+    fprintf(file, "# player <slot> <callsign>\n");
+    fprintf(file, "# base <slot> <state> <score>\n");
+    fprintf(file, "# sample <seconds> [<slot>:<state>:<score change>]...\n");
+    fprintf(file, "# states: 1 = alive, 2 = eliminated\n");
+
+    if (evictedSamples > 0)
+    {
+        fprintf(file, "# truncated: the oldest %d samples were folded into the base scores\n", evictedSamples);
+    }
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        if (!callsigns[i].empty())
+        {
+            fprintf(file, "player %d %s\n", i, callsigns[i].c_str());
+        }
+    }
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        if (baseState[i] != eNotPlaying)
+        {
+            fprintf(file, "base %d %d %d\n", i, baseState[i], baseScore[i]);
+        }
+    }
+
+    unsigned char state[MAX_PLAYER_SLOTS];
+    std::copy(baseState, baseState + MAX_PLAYER_SLOTS, state);
+
+    size_t position = tail;
+    size_t end = tail + used;
+
+    while (position < end)
+    {
+        unsigned int elapsedTime = readVarint(position);
+        unsigned int changes = readVarint(position);
+
+        fprintf(file, "sample %u", elapsedTime);
+
+        for (unsigned int i = 0; i < changes; i++)
+        {
+            int slot, delta;
+            bool advanced;
+
+            decodeChange(position, slot, advanced, delta);
+
+            if (advanced)
+            {
+                state[slot]++;
+            }
+
+            fprintf(file, " %d:%d:%d", slot, state[slot], delta);
+        }
+
+        fprintf(file, "\n");
+    }
+
+    return fclose(file) == 0;
+}
+
+void ScoreTimeline::pushVarint(unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        record.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+
+    record.push_back((unsigned char)value);
+}
+
+// Read a variable length integer from the ring buffer; the position is not wrapped so it can be compared to the end
+unsigned int ScoreTimeline::readVarint(size_t &position)
+{
+    unsigned int value = 0;
+    int shift = 0;
+    unsigned char byte;
+
+    do
+    {
+        byte = buffer[position++ % buffer.size()];
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        shift += 7;
+    }
+    while (byte & 0x80);
+
+    return value;
+}
+
+// Drop the oldest sample from the buffer and apply its changes to the base snapshot
+void ScoreTimeline::evictOldest()
+{
+    size_t position = tail;
+
+    readVarint(position);
+    unsigned int changes = readVarint(position);
+
+    for (unsigned int i = 0; i < changes; i++)
+    {
+        int slot, delta;
+        bool advanced;
+
+        decodeChange(position, slot, advanced, delta);
+
+        if (advanced)
+        {
+            baseState[slot]++;
+        }
+
+        baseScore[slot] += delta;
+    }
+
+    used -= position - tail;
+    tail = position % buffer.size();
+
+    if (evictedSamples++ == 0)
+    {
+        bz_debugMessagef(1, "DEBUG :: Last Tank Standing :: The score timeline buffer is full; the oldest samples of this match will be truncated.");
+    }
+}
+
+// Read the slot, whether its state moved forward, and its score change from the ring buffer
+void ScoreTimeline::decodeChange(size_t &position, int &slot, bool &advanced, int &delta)
+{
+    slot = buffer[position++ % buffer.size()];
+
+    unsigned int encoded = readVarint(position);
+    unsigned int zigzag = encoded >> 1;
+
+    advanced = (encoded & 1);
+    delta = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+}
+
 class lastTankStanding : public bz_Plugin, bz_CustomSlashCommandHandler
 {
 public:
@@ -128,30 +459,59 @@ public:
         eWinner = 4    // A player is "eliminated" for being the winner of the match
     };
 
+    enum MatchPhase
+    {
+        eNoMatch = 0,    // There is no match or countdown running
+        eCountdown = 1,  // The countdown for a new match is in progress
+        eInProgress = 2, // A match is in progress
+        eIntermission = 3 // The plug-in is waiting to automatically start the next match
+    };
+
     virtual const char* Name () { return bztk_pluginName(); }
     virtual void Init (const char* config);
     virtual void Cleanup (void);
     virtual void Event (bz_EventData *eventData);
     virtual bool SlashCommand (int playerID, bz_ApiString, bz_ApiString, bz_APIStringList*);
+    virtual int  GeneralCallback (const char* name, void* data);
 
     virtual void loadConfiguration (const char* configFile);
     virtual void eliminatePlayer (unsigned int playerID, EliminationReason reason);
     virtual void disableMovement (void);
     virtual void enableMovement (void);
+    virtual void prepareMatch (void);
+    virtual void startCountdown (int length);
+    virtual void startIntermission (void);
+    virtual void checkAutoCycle (void);
+    virtual void addToQueue (int playerID);
+    virtual void removeFromQueue (int playerID);
+    virtual bool isQueued (int playerID);
+    virtual int  getMatchPlayerCount (void);
     virtual void checkIdleTime (unsigned int playerID);
+    virtual void recordPosition (int playerID, const float *pos);
+    virtual void resetPositionHistory (int playerID);
+    virtual void samplePositions (void);
+    virtual void checkCampers (void);
+    virtual void setMatchPhase (MatchPhase phase);
+    virtual int  getTimeToElimination (void);
 
     virtual void startRecording (void);
     virtual void endRecording (void);
-    virtual void endGame (void);
+    virtual void saveTimeline (void);
+    virtual void endGame (bool matchFinished);
 
-    double
+    std::string
         bzdb_gravity,            // The default values of certain BZDB variables that we will change to disable movement
-        bzdb_jumpVelocity,       //     so we need to store the original values for when we reenable movement.
-        bzdb_reloadTime,         //
-        bzdb_tankSpeed,          //
+        bzdb_jumpVelocity,       //     so we need to store the original values for when we reenable movement. They're
+        bzdb_reloadTime,         //     stored as strings because BZFS formats doubles with six decimal places, so
+        bzdb_tankSpeed,          //     restoring them as doubles could lose precision.
         bzdb_tankAngVel;         //
 
+    double
+        campDistance;            // The distance a tank must move within the camp time to not be considered camping; 0 disables it
+
     bool
+        autoCycle,               // Whether or not to automatically start the next match when enough players are waiting
+        isMovementDisabled,      // Whether or not tank movement is currently disabled and the original values are saved
         resetScoreOnElimination, // Whether or not to reset all of the players' scores after each elimination
         isCountdownInProgress,   // Whether or not the countdown to start the game is in progress
         isGameInProgress,        // Whether or not a current match is in progress
@@ -160,21 +520,34 @@ public:
         firstRun;                // Whether or not this is the first loop in a game to prevent announcing the amount of
                                  //     seconds remaining until the kick at the start of the game
 
+    MatchPhase
+        matchPhase;              // The current phase of the match that is reported to other plug-ins
+
     int
         countdownProgress,       // The number of seconds still left in the countdown
         countdownLength,         // The duration the countdown for a new game should be
+        campTime,                // The number of seconds a player's movement is measured over to check for camping
+        positionHead,            // The row of the position ring buffer the next sample will be written to
         idleKickTime,            // The number of seconds a player is allowed to idle before getting eliminated automatically
+        intermissionLength,      // The number of seconds to wait after a match before automatically starting the next one
+        queueSize,               // The number of waiting players needed to automatically start the next match
+        timelineInterval,        // The number of seconds between each sample of the score timeline
         roundNumber,             // The current round number of elimination
         kickTime;                // The duration of each round for player elimination
 
     std::string
         gameoverPermission,      // The server permission required to end a game
+        recordDirectory,         // The directory replays are saved to, which should be the same as BZFS' -recdir
         startPermission,         // The server permission required to start a game
         replayFileName;          // The file name used for the recording
 
     time_t
         lastCountdownCheck,      // The time stamp used to keep each number of the countdown exactly one second apart
-        lastEliminationTime;     // The time stamp of the previous elimination of a player
+        intermissionStart,       // The time stamp of when the intermission after the previous match started
+        lastEliminationTime,     // The time stamp of the previous elimination of a player
+        lastPositionSample,      // The time stamp of the last time tank positions were sampled
+        lastTimelineSample,      // The time stamp of the last sample of the score timeline
+        matchStartTime;          // The time stamp of when the current match started
 
     struct RoundElimination
     {
@@ -185,11 +558,39 @@ public:
             callsign;
 
         int
+            playerID,
             rounds,
             score;
     };
 
     std::vector<RoundElimination> eliminations;
+
+    // The IDs of the players waiting to be moved into the next match
+    std::vector<int> matchQueue;
+
+    // The score timeline of the current match that is saved next to its replay
+    ScoreTimeline scoreTimeline;
+
+    // Tank positions are stored as a structure of arrays indexed by player slot so the displacement of every slot can be
+    // calculated in a single pass. Each row of the ring buffer holds the positions sampled at the same second.
+    float
+        lastPositionX[MAX_PLAYER_SLOTS],                       // The most recent position reported by each player
+        lastPositionY[MAX_PLAYER_SLOTS],                       //
+        lastPositionZ[MAX_PLAYER_SLOTS],                       //
+        positionX[MAX_CAMP_TIME + 1][MAX_PLAYER_SLOTS],        // The ring buffer of positions sampled once a second
+        positionY[MAX_CAMP_TIME + 1][MAX_PLAYER_SLOTS],        //
+        positionZ[MAX_CAMP_TIME + 1][MAX_PLAYER_SLOTS],        //
+        displacement[MAX_PLAYER_SLOTS];                        // The squared distance each tank moved within the camp time
+
+    int
+        positionSamples[MAX_PLAYER_SLOTS],                     // The number of consecutive samples recorded for each slot
+        positionTracked[MAX_PLAYER_SLOTS];                     // Whether or not a slot is spawned and reporting positions
+
+    time_t
+        campWarningTime[MAX_PLAYER_SLOTS];                     // The time stamp a player was warned for camping or 0
+
+    // The names of the plug-ins that will be notified through their GeneralCallback() when the match phase changes
+    std::vector<std::string> phaseSubscribers;
 };
 
 BZ_PLUGIN(lastTankStanding)
@@ -202,14 +603,20 @@ void lastTankStanding::Init(const char* commandLine)
     // Set plugin variables
     isCountdownInProgress = false;
     isGameInProgress = false;
+    isMovementDisabled = false;
+    matchPhase = eNoMatch;
+    roundNumber = 0;
 
     // Register our events with Register()
     Register(bz_eBZDBChange);
     Register(bz_eGetAutoTeamEvent);
     Register(bz_eKickEvent);
+    Register(bz_ePlayerDieEvent);
     Register(bz_ePlayerJoinEvent);
     Register(bz_ePlayerPausedEvent);
     Register(bz_ePlayerPartEvent);
+    Register(bz_ePlayerSpawnEvent);
+    Register(bz_ePlayerUpdateEvent);
     Register(bz_eTickEvent);
 
     // Because the team swapping code is far from ideal, there are some issues with tanks moving as observers and getting
@@ -220,11 +627,51 @@ void lastTankStanding::Init(const char* commandLine)
     kickTime        = bztk_registerCustomIntBZDB("_ltsKickTime", 60);
     countdownLength = bztk_registerCustomIntBZDB("_ltsCountdown", 15);
     idleKickTime    = bztk_registerCustomIntBZDB("_ltsIdleKickTime", 30);
+    campTime        = bztk_registerCustomIntBZDB("_ltsCampTime", 30);
+    campDistance    = bztk_registerCustomDoubleBZDB("_ltsCampDistance", 10.0);
+    intermissionLength = bztk_registerCustomIntBZDB("_ltsIntermission", 30);
+    queueSize       = bztk_registerCustomIntBZDB("_ltsQueueSize", 4);
+    timelineInterval = bztk_registerCustomIntBZDB("_ltsTimelineInterval", 5);
+    autoCycle       = bztk_registerCustomBoolBZDB("_ltsAutoCycle", false);
     resetScoreOnElimination = bztk_registerCustomBoolBZDB("_ltsResetScoreOnElimination", false);
 
+    // Values set with -setforced aren't checked by the bz_eBZDBChange event, and the camp time must fit the position ring buffer
+    if (campTime < 10 || campTime > MAX_CAMP_TIME)
+    {
+        campTime = 30;
+    }
+
+    if (campDistance < 0)
+    {
+        campDistance = 10.0;
+    }
+
+    if (intermissionLength < 0)
+    {
+        intermissionLength = 30;
+    }
+
+    if (queueSize < 3)
+    {
+        queueSize = 4;
+    }
+
+    if (timelineInterval < 1)
+    {
+        timelineInterval = 5;
+    }
+
+    positionHead = 0;
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        resetPositionHistory(i);
+    }
+
     // Register custom slash commands
     bz_registerCustomSlashCommand("start", this);
     bz_registerCustomSlashCommand("gameover", this);
+    bz_registerCustomSlashCommand("queue", this);
 
     // Sanity checks/warnings for server owners
     if (bz_getGameType() != eFFAGame && bz_getGameType() != eOpenFFAGame)
@@ -256,6 +703,15 @@ void lastTankStanding::Cleanup(void)
     // Remove our commands
     bz_removeCustomSlashCommand("start");
     bz_removeCustomSlashCommand("gameover");
+    bz_removeCustomSlashCommand("queue");
+
+    // End any match properly so the replay is saved, movement is restored, and subscribers know there's no match anymore
+    if (isGameInProgress || isCountdownInProgress || matchPhase == eIntermission)
+    {
+        endGame(false);
+    }
+
+    phaseSubscribers.clear();
 }
 
 void lastTankStanding::Event(bz_EventData *eventData)
@@ -302,6 +758,74 @@ void lastTankStanding::Event(bz_EventData *eventData)
                     countdownLength = 15;
                 }
             }
+            else if (bzdbChange->key == "_ltsCampTime")
+            {
+                int _campTime = atoi(bzdbChange->value.c_str());
+
+                if (_campTime >= 10 && _campTime <= MAX_CAMP_TIME)
+                {
+                    campTime = _campTime;
+                }
+                else
+                {
+                    campTime = 30;
+                }
+            }
+            else if (bzdbChange->key == "_ltsCampDistance")
+            {
+                if (atof(bzdbChange->value.c_str()) >= 0)
+                {
+                    campDistance = atof(bzdbChange->value.c_str());
+                }
+                else
+                {
+                    campDistance = 10.0;
+                }
+            }
+            else if (bzdbChange->key == "_ltsIntermission")
+            {
+                if (atoi(bzdbChange->value.c_str()) >= 0)
+                {
+                    intermissionLength = atoi(bzdbChange->value.c_str());
+                }
+                else
+                {
+                    intermissionLength = 30;
+                }
+            }
+            else if (bzdbChange->key == "_ltsQueueSize")
+            {
+                if (atoi(bzdbChange->value.c_str()) >= 3)
+                {
+                    queueSize = atoi(bzdbChange->value.c_str());
+                }
+                else
+                {
+                    queueSize = 4;
+                }
+            }
+            else if (bzdbChange->key == "_ltsTimelineInterval")
+            {
+                if (atoi(bzdbChange->value.c_str()) >= 1)
+                {
+                    timelineInterval = atoi(bzdbChange->value.c_str());
+                }
+                else
+                {
+                    timelineInterval = 5;
+                }
+            }
+            else if (bzdbChange->key == "_ltsAutoCycle")
+            {
+                autoCycle = (bzdbChange->value == "1" || bzdbChange->value == "true" || bzdbChange->value == "on");
+
+                // Let everyone move again if we were waiting to start the next match automatically
+                if (!autoCycle && matchPhase == eIntermission)
+                {
+                    enableMovement();
+                    setMatchPhase(eNoMatch);
+                }
+            }
             else if (bzdbChange->key == "_ltsResetScoreOnElimination")
             {
                 if (bzdbChange->value == "1" || bzdbChange->value == "true" || bzdbChange->value == "on")
@@ -314,6 +838,7 @@ void lastTankStanding::Event(bz_EventData *eventData)
                 }
             }
         }
+        break;
 
         case bz_eGetAutoTeamEvent: // This event is called for each new player is added to a team
         {
@@ -326,7 +851,10 @@ void lastTankStanding::Event(bz_EventData *eventData)
                 autoTeamData->handled = true;
                 autoTeamData->team = eObservers;
 
+                addToQueue(autoTeamData->playerID);
+
                 bz_sendTextMessage(BZ_SERVER, autoTeamData->playerID, "There is a currently a match in progress, you have automatically become an observer.");
+                bz_sendTextMessage(BZ_SERVER, autoTeamData->playerID, "You have been added to the queue for the next match; use /queue to leave it.");
             }
         }
         break;
@@ -342,6 +870,14 @@ void lastTankStanding::Event(bz_EventData *eventData)
         }
         break;
 
+        case bz_ePlayerDieEvent: // A dead tank isn't camping, so stop tracking it until it spawns again
+        {
+            bz_PlayerDieEventData_V1* dieData = (bz_PlayerDieEventData_V1*)eventData;
+
+            resetPositionHistory(dieData->playerID);
+        }
+        break;
+
         case bz_ePlayerJoinEvent:
         {
             bz_PlayerJoinPartEventData_V1* joinData = (bz_PlayerJoinPartEventData_V1*)eventData;
@@ -368,19 +904,45 @@ void lastTankStanding::Event(bz_EventData *eventData)
         }
         break;
 
-        case bz_ePlayerPartEvent:
+        case bz_ePlayerSpawnEvent: // Don't compare positions from before a tank respawned
         {
-            bz_PlayerJoinPartEventData_V1* partData = (bz_PlayerJoinPartEventData_V1*)eventData;
+            bz_PlayerSpawnEventData_V1* spawnData = (bz_PlayerSpawnEventData_V1*)eventData;
 
-            if (isGameInProgress && partData->record->team != eObservers)
-            {
-                eliminatePlayer(partData->playerID, eForfeit);
-            }
+            resetPositionHistory(spawnData->playerID);
         }
+        break;
 
-        case bz_eTickEvent: // Server tick cycle
+        case bz_ePlayerUpdateEvent: // This event is called each time a player sends an update of their position
         {
-            // The game countdown is in progress
+            bz_PlayerUpdateEventData_V1* updateData = (bz_PlayerUpdateEventData_V1*)eventData;
+
+            recordPosition(updateData->playerID, updateData->state.pos);
+        }
+        break;
+
+        case bz_ePlayerPartEvent:
+        {
+            bz_PlayerJoinPartEventData_V1* partData = (bz_PlayerJoinPartEventData_V1*)eventData;
+
+            resetPositionHistory(partData->playerID);
+            removeFromQueue(partData->playerID);
+
+            if (isGameInProgress && partData->record && partData->record->team != eObservers)
+            {
+                eliminatePlayer(partData->playerID, eForfeit);
+            }
+        }
+        break;
+
+        case bz_eTickEvent: // Server tick cycle
+        {
+            // Check whether enough players are waiting or the intermission is over to start the next match
+            if (autoCycle && !isCountdownInProgress && !isGameInProgress)
+            {
+                checkAutoCycle();
+            }
+
+            // The game countdown is in progress
             if (isCountdownInProgress)
             {
                 // Get the current time
@@ -393,9 +955,6 @@ void lastTankStanding::Event(bz_EventData *eventData)
                     // If we've reached 0, the game has started!
                     if (countdownProgress < 1)
                     {
-                        // A BZDB variable that the 'mapchange' plug-in will respect when attempting to '/mapchange' during a LTS match
-                        bz_updateBZDBBool("_mapchangeDisable", true);
-
                         isCountdownInProgress = false;
                         isGameInProgress = true;
 
@@ -406,6 +965,20 @@ void lastTankStanding::Event(bz_EventData *eventData)
                         bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "The player at the bottom of the scoreboard will be removed every %d seconds.", kickTime);
 
                         time(&lastEliminationTime); // Have the last kick time be the beginning of the game
+                        time(&lastPositionSample);
+                        time(&lastTimelineSample);
+                        time(&matchStartTime);
+
+                        scoreTimeline.reset();
+                        scoreTimeline.sample(0);
+
+                        // Forget any positions from before the match started, tanks couldn't move during the countdown
+                        for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+                        {
+                            resetPositionHistory(i);
+                        }
+
+                        setMatchPhase(eInProgress);
                     }
                     else // We're still counting down
                     {
@@ -418,6 +991,19 @@ void lastTankStanding::Event(bz_EventData *eventData)
 
             if (isGameInProgress) // The game is in progress
             {
+                // Only keep a score timeline when we'll be saving it next to the replay
+                if (recordMatch && matchRecording && !recordDirectory.empty())
+                {
+                    time_t currentTime;
+                    time(&currentTime);
+
+                    if (difftime(currentTime, lastTimelineSample) >= timelineInterval)
+                    {
+                        scoreTimeline.sample((int)difftime(currentTime, matchStartTime));
+                        time(&lastTimelineSample);
+                    }
+                }
+
                 if (bztk_getPlayerCount() > 1) // If there are more than one player playing...
                 {
                     time_t currentTime;
@@ -435,25 +1021,34 @@ void lastTankStanding::Event(bz_EventData *eventData)
                         }
                     }
 
+                    // Sample tank positions once a second to catch players camping or spinning in place
+                    if (difftime(currentTime, lastPositionSample) >= 1)
+                    {
+                        samplePositions();
+                        checkCampers();
+
+                        time(&lastPositionSample);
+                    }
+
                     if (timeRemaining >= kickTime) // If we've reached the time to eliminate someone
                     {
-                        if (getPlayerWithLowestScore() < 0) // If the player is -1 then that means more than one player has the same low score
+                        int lowestPlayer = getPlayerWithLowestScore();
+
+                        // Make a reference object of the player in last place
+                        std::unique_ptr<bz_BasePlayerRecord> lastPlace((lowestPlayer < 0) ? NULL : bz_getPlayerByIndex(lowestPlayer));
+
+                        if (lowestPlayer < 0) // If the player is -1 then that means more than one player has the same low score
                         {
                             bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "Multiple players with lowest score ... nobody gets eliminated" );
                             bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "Next elimination in %d seconds ... ", kickTime );
                         }
+                        else if (!lastPlace) // The player left between looking them up and eliminating them, so treat it like a tie
+                        {
+                            bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "Wait. Where'd the player go? Player to be eliminated not found!");
+                            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "Next elimination in %d seconds ... ", kickTime );
+                        }
                         else
                         {
-                            // Make a reference object of the player in last place
-                            std::unique_ptr<bz_BasePlayerRecord> lastPlace(bz_getPlayerByIndex(getPlayerWithLowestScore()));
-
-                            // The player doesn't exist for some reason
-                            if (!lastPlace)
-                            {
-                                bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "Wait. Where'd the player go? Player to be eliminated not found!");
-                                return;
-                            }
-
                             // There are only two players left meaning the next one eliminated means the game is
                             // Don't announce next elimination period
                             if (bztk_getPlayerCount() == 2)
@@ -505,7 +1100,10 @@ void lastTankStanding::Event(bz_EventData *eventData)
                     }
 
                     // We need to eliminate the winner so we can compleate the scoreboard. Strange concept, I know.
-                    eliminatePlayer(lastTankStanding->playerID, eWinner);
+                    if (lastTankStanding)
+                    {
+                        eliminatePlayer(lastTankStanding->playerID, eWinner);
+                    }
 
                     // Reverse the order of the elimination record so we can get the most recent first
                     std::reverse(eliminations.begin(), eliminations.end());
@@ -546,13 +1144,13 @@ void lastTankStanding::Event(bz_EventData *eventData)
                         position++;
                     }
 
-                    endGame();
+                    endGame(true);
                 }
                 else
                 {
                     bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "The current match was ended automatically with no winner.");
 
-                    endGame();
+                    endGame(true);
                 }
             }
         }
@@ -574,35 +1172,22 @@ bool lastTankStanding::SlashCommand(int playerID, bz_ApiString command, bz_ApiSt
         {
             bz_sendTextMessage(BZ_SERVER, playerID, "There is already a game of Last Tank Standing in progress.");
         }
-        else if (bztk_getPlayerCount() <= 2)
+        else if (getMatchPlayerCount() <= 2)
         {
             bz_sendTextMessage(BZ_SERVER, playerID, "More than 2 players are required to play a game of Last Tank Standing.");
         }
         else
         {
-            // Setup variables and stuff
-            time(&lastCountdownCheck);
-            isCountdownInProgress = true;
-            roundNumber = 1;
-            firstRun = true;
+            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s started a new game of Last Tank Standing", bz_getPlayerCallsign(playerID));
 
             if (params->size() > 0 && atoi(params->get(0).c_str()) >= 15)
             {
-                countdownProgress = atoi(params->get(0).c_str());
+                startCountdown(atoi(params->get(0).c_str()));
             }
             else
             {
-                countdownProgress = countdownLength;
+                startCountdown(countdownLength);
             }
-
-            startRecording();
-
-            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s started a new game of Last Tank Standing", bz_getPlayerByIndex(playerID)->callsign.c_str());
-
-            // Reset scores and disable movement
-            bztk_foreachPlayer(resetPlayerScore);
-            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "All scores have been reset.");
-            disableMovement();
         }
 
         return true;
@@ -613,11 +1198,41 @@ bool lastTankStanding::SlashCommand(int playerID, bz_ApiString command, bz_ApiSt
         {
             bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s has ended the current game of Last Tank Standing.", bz_getPlayerCallsign(playerID));
 
-            endGame();
+            endGame(false);
+        }
+        else if (matchPhase == eIntermission) // Cancel the match we were about to start automatically
+        {
+            bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "%s has cancelled the next game of Last Tank Standing.", bz_getPlayerCallsign(playerID));
+
+            enableMovement();
+            setMatchPhase(eNoMatch);
         }
         else // No game to end, silly admin
         {
             bz_sendTextMessage(BZ_SERVER, playerID, "There is no active game of Last Tank Standing.");
+            return true;
+        }
+
+        // Don't let the players waiting in the queue start another match right after an admin ended this one
+        if (autoCycle && !matchQueue.empty())
+        {
+            matchQueue.clear();
+            bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "The queue for the next match has been cleared, use /queue to join it again.");
+        }
+
+        return true;
+    }
+    else if (command == "queue") // Any player may join or leave the queue for the next match
+    {
+        if (isQueued(playerID))
+        {
+            removeFromQueue(playerID);
+            bz_sendTextMessage(BZ_SERVER, playerID, "You have left the queue for the next match of Last Tank Standing.");
+        }
+        else
+        {
+            addToQueue(playerID);
+            bz_sendTextMessagef(BZ_SERVER, playerID, "You have joined the queue for the next match of Last Tank Standing (%d/%d players queued).", (int)matchQueue.size(), queueSize);
         }
 
         return true;
@@ -633,9 +1248,67 @@ bool lastTankStanding::SlashCommand(int playerID, bz_ApiString command, bz_ApiSt
     return false;
 }
 
+// Allow other plug-ins to query the state of the current match in-process with bz_callPluginGenericCallback() instead of
+// relying on BZDB variables, which are sent to every connected client whenever they change
+int lastTankStanding::GeneralCallback(const char* name, void* data)
+{
+    if (!name)
+    {
+        return 0;
+    }
+
+    std::string callback = name;
+
+    if (callback == "getPhase")
+    {
+        return matchPhase;
+    }
+    else if (callback == "getRound")
+    {
+        return (matchPhase == eInProgress) ? roundNumber : 0;
+    }
+    else if (callback == "getAlivePlayers") // Optionally fill a bz_APIIntList passed as data with the IDs of the players
+    {
+        if (data)
+        {
+            getAlivePlayers((bz_APIIntList*)data);
+        }
+
+        return bztk_getPlayerCount();
+    }
+    else if (callback == "getTimeToElimination")
+    {
+        return getTimeToElimination();
+    }
+    else if (callback == "subscribePhaseChange" || callback == "unsubscribePhaseChange") // The data is the subscriber's plug-in name
+    {
+        if (!data || ((const char*)data)[0] == '\0')
+        {
+            return 0;
+        }
+
+        std::string subscriber = (const char*)data;
+        auto existing = std::find(phaseSubscribers.begin(), phaseSubscribers.end(), subscriber);
+
+        if (callback == "subscribePhaseChange" && existing == phaseSubscribers.end())
+        {
+            phaseSubscribers.push_back(subscriber);
+        }
+        else if (callback == "unsubscribePhaseChange" && existing != phaseSubscribers.end())
+        {
+            phaseSubscribers.erase(existing);
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
 void lastTankStanding::loadConfiguration(const char* configFile)
 {
     recordMatch        = false;
+    recordDirectory    = "";
     startPermission    = "vote";
     gameoverPermission = "endgame";
 
@@ -651,6 +1324,7 @@ void lastTankStanding::loadConfiguration(const char* configFile)
         else
         {
             recordMatch        = toBool(config.item(section, "RECORD_MATCHES"));
+            recordDirectory    = config.item(section, "RECORD_DIR");
             startPermission    = config.item(section, "GAME_START_PERM");
             gameoverPermission = config.item(section, "GAME_END_PERM");
         }
@@ -659,13 +1333,36 @@ void lastTankStanding::loadConfiguration(const char* configFile)
     bz_debugMessagef(2, "DEBUG :: Last Tank Standing :: The /start command requires the '%s' permission.", startPermission.c_str());
     bz_debugMessagef(2, "DEBUG :: Last Tank Standing :: The /gameover command requires the '%s' permission.", gameoverPermission.c_str());
     bz_debugMessagef(2, "DEBUG :: Last Tank Standing :: LTS Matches %s be recored", (recordMatch) ? "will be" : "will not be");
+
+    if (recordMatch && recordDirectory.empty())
+    {
+        bz_debugMessage(0, "WARNING :: Last Tank Standing :: RECORD_DIR is not set; score timelines will not be saved with LTS replays.");
+    }
 }
 
 void lastTankStanding::eliminatePlayer(unsigned int playerID, EliminationReason reason)
 {
+    const char* callsign = bz_getPlayerCallsign(playerID);
+
+    // The player has already left the server
+    if (!callsign)
+    {
+        return;
+    }
+
+    // A player who is kicked will also part, so only record the first reason they were eliminated for
+    for (auto &player : eliminations)
+    {
+        if (player.playerID == (int)playerID && player.callsign == callsign)
+        {
+            return;
+        }
+    }
+
     RoundElimination record;
 
-    record.callsign = bz_getPlayerCallsign(playerID);
+    record.playerID = playerID;
+    record.callsign = callsign;
     record.score    = bz_getPlayerWins(playerID) - bz_getPlayerLosses(playerID);
     record.rounds   = roundNumber;
     record.reason   = reason;
@@ -676,12 +1373,20 @@ void lastTankStanding::eliminatePlayer(unsigned int playerID, EliminationReason
 // Disable tanks from movement and shooting
 void lastTankStanding::disableMovement()
 {
+    // Don't overwrite the original values we saved with the values we use to disable movement
+    if (isMovementDisabled)
+    {
+        return;
+    }
+
+    isMovementDisabled = true;
+
     // Save variable settings
-    bzdb_gravity      = bz_getBZDBDouble("_gravity");
-    bzdb_jumpVelocity = bz_getBZDBDouble("_jumpVelocity");
-    bzdb_reloadTime   = bz_getBZDBDouble("_reloadTime");
-    bzdb_tankAngVel   = bz_getBZDBDouble("_tankAngVel");
-    bzdb_tankSpeed    = bz_getBZDBDouble("_tankSpeed");
+    bzdb_gravity      = bz_getBZDBString("_gravity").c_str();
+    bzdb_jumpVelocity = bz_getBZDBString("_jumpVelocity").c_str();
+    bzdb_reloadTime   = bz_getBZDBString("_reloadTime").c_str();
+    bzdb_tankAngVel   = bz_getBZDBString("_tankAngVel").c_str();
+    bzdb_tankSpeed    = bz_getBZDBString("_tankSpeed").c_str();
 
     // Disable movement and shooting
     bz_updateBZDBDouble("_gravity", -1000.000000);
@@ -694,17 +1399,148 @@ void lastTankStanding::disableMovement()
 // Enable tanks to move and shoot again
 void lastTankStanding::enableMovement()
 {
-    bz_updateBZDBDouble("_gravity", bzdb_gravity);
-    bz_updateBZDBDouble("_jumpVelocity", bzdb_jumpVelocity);
-    bz_updateBZDBDouble("_reloadTime", bzdb_reloadTime);
-    bz_updateBZDBDouble("_tankAngVel", bzdb_tankAngVel);
-    bz_updateBZDBDouble("_tankSpeed", bzdb_tankSpeed);
+    if (!isMovementDisabled)
+    {
+        return;
+    }
+
+    isMovementDisabled = false;
+
+    bz_updateBZDBString("_gravity", bzdb_gravity.c_str());
+    bz_updateBZDBString("_jumpVelocity", bzdb_jumpVelocity.c_str());
+    bz_updateBZDBString("_reloadTime", bzdb_reloadTime.c_str());
+    bz_updateBZDBString("_tankAngVel", bzdb_tankAngVel.c_str());
+    bz_updateBZDBString("_tankSpeed", bzdb_tankSpeed.c_str());
 }
 
+// Reset scores and disable movement for the next match unless it has already been prepared during the intermission
+void lastTankStanding::prepareMatch()
+{
+    if (isMovementDisabled)
+    {
+        return;
+    }
+
+    bztk_foreachPlayer(resetPlayerScore);
+    bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "All scores have been reset.");
+    disableMovement();
+}
+
+// Start the countdown for a new match and move all of the players waiting in the queue into the match
+void lastTankStanding::startCountdown(int length)
+{
+    // Setup variables and stuff
+    time(&lastCountdownCheck);
+    isCountdownInProgress = true;
+    countdownProgress = length;
+    roundNumber = 1;
+    firstRun = true;
+
+    for (auto &playerID : matchQueue)
+    {
+        if (bz_getPlayerTeam(playerID) == eObservers)
+        {
+            bztk_changeTeam(playerID, eRogueTeam);
+        }
+    }
+
+    matchQueue.clear();
+
+    startRecording();
+    prepareMatch();
+
+    setMatchPhase(eCountdown);
+}
+
+// Prepare the next match while waiting for players so the countdown can start as soon as the intermission is over
+void lastTankStanding::startIntermission()
+{
+    // Enough players are already waiting, so there's no reason to wait for the intermission
+    if ((int)matchQueue.size() >= queueSize && getMatchPlayerCount() > 2)
+    {
+        bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "A new game of Last Tank Standing is starting automatically.");
+
+        startCountdown(countdownLength);
+        return;
+    }
+
+    time(&intermissionStart);
+
+    prepareMatch();
+    setMatchPhase(eIntermission);
+
+    bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "The next match of Last Tank Standing will start in %d seconds, or once %d players have joined with /queue.", intermissionLength, queueSize);
+}
+
+// Automatically start the next match if enough players are waiting or the intermission is over
+void lastTankStanding::checkAutoCycle()
+{
+    time_t currentTime;
+    time(&currentTime);
+
+    bool queueFull = ((int)matchQueue.size() >= queueSize);
+    bool intermissionOver = (matchPhase == eIntermission && difftime(currentTime, intermissionStart) >= intermissionLength);
+
+    if ((queueFull || intermissionOver) && getMatchPlayerCount() > 2)
+    {
+        bz_sendTextMessage(BZ_SERVER, BZ_ALLUSERS, "A new game of Last Tank Standing is starting automatically.");
+
+        startCountdown(countdownLength);
+    }
+    else if (intermissionOver) // Not enough players, so let everyone move until the queue fills up
+    {
+        bz_sendTextMessagef(BZ_SERVER, BZ_ALLUSERS, "Not enough players are waiting; the next match will start when %d players have joined with /queue.", queueSize);
+
+        enableMovement();
+        setMatchPhase(eNoMatch);
+    }
+}
+
+void lastTankStanding::addToQueue(int playerID)
+{
+    if (!isQueued(playerID))
+    {
+        matchQueue.push_back(playerID);
+    }
+}
+
+void lastTankStanding::removeFromQueue(int playerID)
+{
+    matchQueue.erase(std::remove(matchQueue.begin(), matchQueue.end(), playerID), matchQueue.end());
+}
+
+bool lastTankStanding::isQueued(int playerID)
+{
+    return std::find(matchQueue.begin(), matchQueue.end(), playerID) != matchQueue.end();
+}
+
+// Get the number of players who would play in a match started now; i.e. players who are queued or are not observers
+int lastTankStanding::getMatchPlayerCount()
+{
+    int readyPlayers = 0;
+
+    std::unique_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
+
+    for (unsigned int i = 0; i < playerList->size(); i++)
+    {
+        if (bz_getPlayerTeam(playerList->get(i)) != eObservers || isQueued(playerList->get(i)))
+        {
+            readyPlayers++;
+        }
+    }
+
+    return readyPlayers;
+}
 
 // Switch players if they have idled too long or are paused for too long
 void lastTankStanding::checkIdleTime(unsigned int playerID)
 {
+    // Observers have either been eliminated already or aren't part of the match
+    if (bz_getPlayerTeam(playerID) == eObservers)
+    {
+        return;
+    }
+
     // Check the amount of time a player has been idle or paused. We will automatically eliminate players if they idle for too long
     if (bz_getIdleTime(playerID) >= bz_getBZDBDouble("_ltsIdleKickTime"))
     {
@@ -715,6 +1551,156 @@ void lastTankStanding::checkIdleTime(unsigned int playerID)
     }
 }
 
+// Store the most recent position reported by a player; the position is only sampled once a second in the tick event
+void lastTankStanding::recordPosition(int playerID, const float *pos)
+{
+    if (playerID < 0 || playerID >= MAX_PLAYER_SLOTS)
+    {
+        return;
+    }
+
+    lastPositionX[playerID] = pos[0];
+    lastPositionY[playerID] = pos[1];
+    lastPositionZ[playerID] = pos[2];
+    positionTracked[playerID] = 1;
+}
+
+// Forget the positions recorded for a player slot
+void lastTankStanding::resetPositionHistory(int playerID)
+{
+    if (playerID < 0 || playerID >= MAX_PLAYER_SLOTS)
+    {
+        return;
+    }
+
+    lastPositionX[playerID] = lastPositionY[playerID] = lastPositionZ[playerID] = 0;
+    positionSamples[playerID] = 0;
+    positionTracked[playerID] = 0;
+    campWarningTime[playerID] = 0;
+}
+
+// Copy the latest positions of every slot into the ring buffer and calculate how far each tank has moved within the camp
+// time. Every slot is processed regardless of how many players are connected so the cost of each sample stays the same.
+void lastTankStanding::samplePositions()
+{
+    const int rows = MAX_CAMP_TIME + 1;
+
+    float *x = positionX[positionHead];
+    float *y = positionY[positionHead];
+    float *z = positionZ[positionHead];
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        x[i] = lastPositionX[i];
+        y[i] = lastPositionY[i];
+        z[i] = lastPositionZ[i];
+
+        // Untracked slots start counting their samples over
+        positionSamples[i] = (positionSamples[i] + 1) * positionTracked[i];
+    }
+
+    int oldest = (positionHead + rows - campTime) % rows;
+
+    const float *oldX = positionX[oldest];
+    const float *oldY = positionY[oldest];
+    const float *oldZ = positionZ[oldest];
+
+    for (int i = 0; i < MAX_PLAYER_SLOTS; i++)
+    {
+        float dx = x[i] - oldX[i];
+        float dy = y[i] - oldY[i];
+        float dz = z[i] - oldZ[i];
+
+        displacement[i] = dx * dx + dy * dy + dz * dz;
+    }
+
+    positionHead = (positionHead + 1) % rows;
+}
+
+// Warn players who haven't moved far enough within the camp time and eliminate them if they still haven't moved after
+// being warned
+void lastTankStanding::checkCampers()
+{
+    if (campDistance <= 0)
+    {
+        return;
+    }
+
+    float threshold = campDistance * campDistance;
+
+    time_t currentTime;
+    time(&currentTime);
+
+    std::unique_ptr<bz_APIIntList> playerList(bz_getPlayerIndexList());
+
+    for (unsigned int i = 0; i < playerList->size(); i++)
+    {
+        int playerID = playerList->get(i);
+
+        if (playerID < 0 || playerID >= MAX_PLAYER_SLOTS || bz_getPlayerTeam(playerID) == eObservers)
+        {
+            continue;
+        }
+
+        // We don't have a full window of positions for this player yet or they've moved enough
+        if (positionSamples[playerID] <= campTime || displacement[playerID] >= threshold)
+        {
+            campWarningTime[playerID] = 0;
+            continue;
+        }
+
+        if (campWarningTime[playerID] == 0)
+        {
+            bz_sendTextMessagef(BZ_SERVER, playerID, "Warning: Camping or spinning in place during a match is unsportsmanlike conduct.");
+            bz_sendTextMessagef(BZ_SERVER, playerID, "         You will automatically be eliminated in %d seconds if you do not move.", CAMP_WARNING_TIME);
+
+            campWarningTime[playerID] = currentTime;
+        }
+        else if (difftime(currentTime, campWarningTime[playerID]) >= CAMP_WARNING_TIME)
+        {
+            bztk_changeTeam(playerID, eObservers);
+            eliminatePlayer(playerID, eIdleTime);
+            resetPositionHistory(playerID);
+
+            bz_sendTextMessagef(BZ_SERVER, playerID, "You have been automatically eliminated for camping.");
+        }
+    }
+}
+
+// Update the phase of the match and notify any plug-ins that have subscribed to phase changes
+void lastTankStanding::setMatchPhase(MatchPhase phase)
+{
+    if (matchPhase == phase)
+    {
+        return;
+    }
+
+    matchPhase = phase;
+
+    // Copy the list in case a subscriber unsubscribes itself while we're notifying it
+    std::vector<std::string> subscribers = phaseSubscribers;
+    int phaseData = phase;
+
+    for (auto &subscriber : subscribers)
+    {
+        bz_callPluginGenericCallback(subscriber.c_str(), "ltsPhaseChange", &phaseData);
+    }
+}
+
+// Get the number of seconds until the next player elimination, or -1 if there is no match in progress
+int lastTankStanding::getTimeToElimination()
+{
+    if (matchPhase != eInProgress)
+    {
+        return -1;
+    }
+
+    time_t currentTime;
+    time(&currentTime);
+
+    return std::max(0, kickTime - (int)difftime(currentTime, lastEliminationTime));
+}
+
 void lastTankStanding::startRecording()
 {
     if (recordMatch)
@@ -745,15 +1731,72 @@ void lastTankStanding::endRecording()
     }
 }
 
-void lastTankStanding::endGame()
+// Save the score timeline of the match next to its replay with the same name and a '.timeline' extension
+void lastTankStanding::saveTimeline()
 {
-    bz_updateBZDBBool("_mapchangeDisable", false);
+    if (!isGameInProgress || !recordMatch || !matchRecording || recordDirectory.empty())
+    {
+        return;
+    }
+
+    time_t currentTime;
+    time(&currentTime);
+
+    // Take one last sample so the timeline includes how the match ended
+    scoreTimeline.sample((int)difftime(currentTime, matchStartTime));
+
+    std::string fileName = recordDirectory;
+
+    if (fileName[fileName.size() - 1] != '/')
+    {
+        fileName += "/";
+    }
+
+    fileName += replayFileName.substr(0, replayFileName.rfind(".rec")) + ".timeline";
+
+    if (scoreTimeline.save(fileName))
+    {
+        bz_debugMessagef(2, "DEBUG :: Last Tank Standing :: Score timeline saved as: %s", fileName.c_str());
+    }
+    else
+    {
+        bz_debugMessagef(0, "WARNING :: Last Tank Standing :: The score timeline could not be saved as: %s", fileName.c_str());
+    }
+}
+
+// End the current match; only a match that finished on its own leads to an intermission when auto cycling is enabled
+void lastTankStanding::endGame(bool matchFinished)
+{
+    saveTimeline();
 
     isCountdownInProgress = false;
     isGameInProgress = false;
     roundNumber = 0;
 
+    // Players who played through the match to the end get to play in the next one
+    if (autoCycle && matchFinished)
+    {
+        for (auto &player : eliminations)
+        {
+            const char* callsign = bz_getPlayerCallsign(player.playerID);
+
+            if ((player.reason == eLowScore || player.reason == eWinner) && callsign && player.callsign == callsign)
+            {
+                addToQueue(player.playerID);
+            }
+        }
+    }
+
     eliminations.clear();
-    enableMovement();
     endRecording();
+
+    if (autoCycle && matchFinished)
+    {
+        startIntermission();
+    }
+    else
+    {
+        enableMovement();
+        setMatchPhase(eNoMatch);
+    }
 }
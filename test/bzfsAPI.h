@@ -0,0 +1,321 @@
+/*
+    Copyright (C) 2013-2016 Vladimir "allejo" Jimenez
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+// A stand-in for the parts of the BZFS API used by this plug-in so it can be driven by the soak test without a server.
+// Only the declarations the plug-in needs are here; the fake server behind them lives in soak.cpp.
+
+#ifndef _BZFS_API_H_
+#define _BZFS_API_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+#define BZ_SERVER   -2
+#define BZ_ALLUSERS -1
+
+typedef enum
+{
+    eNoTeam = -1,
+    eRogueTeam = 0,
+    eRedTeam,
+    eGreenTeam,
+    eBlueTeam,
+    ePurpleTeam,
+    eRabbitTeam,
+    eHunterTeam,
+    eObservers,
+    eAdministrators
+} bz_eTeamType;
+
+typedef enum
+{
+    eFFAGame = 0,
+    eCTFGame,
+    eRabbitGame,
+    eOpenFFAGame
+} bz_eGameType;
+
+typedef enum
+{
+    bz_eNullEvent = 0,
+    bz_eBZDBChange,
+    bz_eGetAutoTeamEvent,
+    bz_eKickEvent,
+    bz_ePlayerDieEvent,
+    bz_ePlayerJoinEvent,
+    bz_ePlayerPartEvent,
+    bz_ePlayerPausedEvent,
+    bz_ePlayerSpawnEvent,
+    bz_ePlayerUpdateEvent,
+    bz_eTickEvent,
+    bz_eLastEvent
+} bz_eEventType;
+
+// Objects the API hands to plug-ins are counted so the soak test can check that every one of them is freed
+extern long bz_fakeLiveObjects;
+
+// Like the real class, the string is kept private so anything that needs a std::string has to go through c_str()
+class bz_ApiString
+{
+public:
+    bz_ApiString() {}
+    bz_ApiString(const char* c) : data(c ? c : "") {}
+    bz_ApiString(const std::string &s) : data(s) {}
+
+    bz_ApiString& operator = (const char* c) { data = (c ? c : ""); return *this; }
+    bz_ApiString& operator = (const std::string &s) { data = s; return *this; }
+
+    bool operator == (const char* c) const { return data == (c ? c : ""); }
+    bool operator == (const std::string &s) const { return data == s; }
+    bool operator == (const bz_ApiString &s) const { return data == s.data; }
+    bool operator != (const char* c) const { return !(*this == c); }
+    bool operator != (const std::string &s) const { return !(*this == s); }
+    bool operator != (const bz_ApiString &s) const { return !(*this == s); }
+
+    unsigned int size() const { return (unsigned int)data.size(); }
+    bool empty() const { return data.empty(); }
+    const char* c_str() const { return data.c_str(); }
+
+private:
+    std::string data;
+};
+
+class bz_APIIntList
+{
+public:
+    bz_APIIntList() { bz_fakeLiveObjects++; }
+    ~bz_APIIntList() { bz_fakeLiveObjects--; }
+
+    unsigned int size() { return (unsigned int)list.size(); }
+    int get(unsigned int i) { return list[i]; }
+    void push_back(int value) { list.push_back(value); }
+    void clear() { list.clear(); }
+
+    std::vector<int> list;
+};
+
+class bz_APIStringList
+{
+public:
+    unsigned int size() { return (unsigned int)list.size(); }
+    bz_ApiString get(unsigned int i) { return list[i]; }
+    void push_back(const std::string &value) { list.push_back(value); }
+
+    std::vector<bz_ApiString> list;
+};
+
+struct bz_PlayerUpdateState
+{
+    float pos[3];
+    float rotation;
+};
+
+class bz_BasePlayerRecord
+{
+public:
+    bz_BasePlayerRecord() : playerID(-1), team(eNoTeam), wins(0), losses(0) { bz_fakeLiveObjects++; }
+    ~bz_BasePlayerRecord() { bz_fakeLiveObjects--; }
+
+    int playerID;
+    bz_ApiString callsign;
+    bz_eTeamType team;
+    int wins;
+    int losses;
+};
+
+class bz_EventData
+{
+public:
+    bz_EventData(bz_eEventType type = bz_eNullEvent) : eventType(type), eventTime(0) {}
+    virtual ~bz_EventData() {}
+
+    bz_eEventType eventType;
+    double eventTime;
+};
+
+class bz_BZDBChangeData_V1 : public bz_EventData
+{
+public:
+    bz_BZDBChangeData_V1(const std::string &k, const std::string &v) : bz_EventData(bz_eBZDBChange), key(k), value(v) {}
+
+    bz_ApiString key;
+    bz_ApiString value;
+};
+
+class bz_GetAutoTeamEventData_V1 : public bz_EventData
+{
+public:
+    bz_GetAutoTeamEventData_V1() : bz_EventData(bz_eGetAutoTeamEvent), playerID(-1), team(eNoTeam), handled(false) {}
+
+    int playerID;
+    bz_ApiString callsign;
+    bz_eTeamType team;
+    bool handled;
+};
+
+class bz_KickEventData_V1 : public bz_EventData
+{
+public:
+    bz_KickEventData_V1() : bz_EventData(bz_eKickEvent), kickerID(-1), kickedID(-1) {}
+
+    int kickerID;
+    int kickedID;
+    bz_ApiString reason;
+};
+
+class bz_PlayerDieEventData_V1 : public bz_EventData
+{
+public:
+    bz_PlayerDieEventData_V1() : bz_EventData(bz_ePlayerDieEvent), playerID(-1), killerID(-1) {}
+
+    int playerID;
+    int killerID;
+};
+
+class bz_PlayerJoinPartEventData_V1 : public bz_EventData
+{
+public:
+    bz_PlayerJoinPartEventData_V1(bz_eEventType type) : bz_EventData(type), playerID(-1), record(NULL) {}
+
+    int playerID;
+    bz_BasePlayerRecord* record;
+    bz_ApiString reason;
+};
+
+class bz_PlayerPausedEventData_V1 : public bz_EventData
+{
+public:
+    bz_PlayerPausedEventData_V1() : bz_EventData(bz_ePlayerPausedEvent), playerID(-1), pause(false) {}
+
+    int playerID;
+    bool pause;
+};
+
+class bz_PlayerSpawnEventData_V1 : public bz_EventData
+{
+public:
+    bz_PlayerSpawnEventData_V1() : bz_EventData(bz_ePlayerSpawnEvent), playerID(-1) {}
+
+    int playerID;
+};
+
+class bz_PlayerUpdateEventData_V1 : public bz_EventData
+{
+public:
+    bz_PlayerUpdateEventData_V1() : bz_EventData(bz_ePlayerUpdateEvent), playerID(-1), stateTime(0) {}
+
+    int playerID;
+    bz_PlayerUpdateState state;
+    bz_PlayerUpdateState lastState;
+    double stateTime;
+};
+
+class bz_TickEventData_V1 : public bz_EventData
+{
+public:
+    bz_TickEventData_V1() : bz_EventData(bz_eTickEvent) {}
+};
+
+struct bz_Time
+{
+    int year, month, day, hour, minute, second, nanosecond, daylightSavings;
+};
+
+class bz_Plugin
+{
+public:
+    bz_Plugin() : MaxWaitTime(-1) {}
+    virtual ~bz_Plugin() {}
+
+    virtual const char* Name() = 0;
+    virtual void Init(const char* config) = 0;
+    virtual void Cleanup() { Flush(); }
+    virtual void Event(bz_EventData *eventData) = 0;
+    virtual int GeneralCallback(const char* /*name*/, void* /*data*/) { return 0; }
+
+    float MaxWaitTime;
+
+protected:
+    bool Register(bz_eEventType eventType);
+    bool Remove(bz_eEventType eventType);
+    void Flush();
+};
+
+class bz_CustomSlashCommandHandler
+{
+public:
+    virtual ~bz_CustomSlashCommandHandler() {}
+    virtual bool SlashCommand(int playerID, bz_ApiString command, bz_ApiString message, bz_APIStringList *params) = 0;
+};
+
+#define BZ_PLUGIN(n) \
+    bz_Plugin* bz_GetPlugin(void) { return new n(); } \
+    void bz_FreePlugin(bz_Plugin* plugin) { delete plugin; }
+
+// Players
+bz_APIIntList* bz_getPlayerIndexList(void);
+bz_BasePlayerRecord* bz_getPlayerByIndex(int playerID);
+const char* bz_getPlayerCallsign(int playerID);
+bz_eTeamType bz_getPlayerTeam(int playerID);
+int bz_getPlayerWins(int playerID);
+int bz_getPlayerLosses(int playerID);
+bool bz_setPlayerWins(int playerID, int wins);
+bool bz_setPlayerLosses(int playerID, int losses);
+bool bz_hasPerm(int playerID, const char* perm);
+float bz_getIdleTime(int playerID);
+
+// Messages
+bool bz_sendTextMessage(int from, int to, const char* message);
+bool bz_sendTextMessagef(int from, int to, const char* fmt, ...);
+void bz_debugMessage(int level, const char* message);
+void bz_debugMessagef(int level, const char* fmt, ...);
+
+// BZDB
+bool bz_BZDBItemExists(const char* variable);
+double bz_getBZDBDouble(const char* variable);
+bz_ApiString bz_getBZDBString(const char* variable);
+bool bz_getBZDBBool(const char* variable);
+int bz_getBZDBInt(const char* variable);
+bool bz_updateBZDBDouble(const char* variable, double val, int perms = 0, bool persistent = false);
+bool bz_updateBZDBString(const char* variable, const char* val, int perms = 0, bool persistent = false);
+bool bz_updateBZDBBool(const char* variable, bool val, int perms = 0, bool persistent = false);
+bool bz_updateBZDBInt(const char* variable, int val, int perms = 0, bool persistent = false);
+
+// Server
+bool bz_registerCustomSlashCommand(const char* command, bz_CustomSlashCommandHandler *handler);
+bool bz_removeCustomSlashCommand(const char* command);
+bz_eGameType bz_getGameType(void);
+int bz_getTeamPlayerLimit(bz_eTeamType team);
+bool bz_isTimeManualStart(void);
+void bz_getLocaltime(bz_Time *ts);
+int bz_callPluginGenericCallback(const char* plugin, const char* name, void* data);
+
+// Recording
+bool bz_startRecBuf(void);
+bool bz_stopRecBuf(void);
+bool bz_saveRecBuf(const char* filename, int seconds = 0);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+    Copyright (C) 2013-2016 Vladimir "allejo" Jimenez
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+// A stand-in for the bzToolkit functions used by this plug-in, implemented on top of the fake API in soak.cpp
+
+#ifndef _BZTOOLKIT_API_H_
+#define _BZTOOLKIT_API_H_
+
+#include "bzfsAPI.h"
+
+const char* bztk_pluginName(void);
+int bztk_getPlayerCount(void);
+void bztk_foreachPlayer(void (*function)(int));
+bool bztk_changeTeam(int playerID, bz_eTeamType team);
+int bztk_registerCustomIntBZDB(const char* variable, int value, int perms = 0, bool persistent = false);
+double bztk_registerCustomDoubleBZDB(const char* variable, double value, int perms = 0, bool persistent = false);
+bool bztk_registerCustomBoolBZDB(const char* variable, bool value, int perms = 0, bool persistent = false);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+    Copyright (C) 2013-2016 Vladimir "allejo" Jimenez
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+// A stand-in for the plugin_utils configuration reader; the soak test fills in the items instead of reading a file
+
+#ifndef _PLUGIN_CONFIG_H_
+#define _PLUGIN_CONFIG_H_
+
+#include <map>
+#include <string>
+
+extern std::map<std::string, std::string> bz_fakeConfigItems;
+
+class PluginConfig
+{
+public:
+    PluginConfig(const std::string & /*filename*/) : errors(0) {}
+
+    std::string item(const std::string & /*section*/, const std::string &key)
+    {
+        return bz_fakeConfigItems.count(key) ? bz_fakeConfigItems[key] : "";
+    }
+
+    unsigned int errors;
+};
+
+#endif
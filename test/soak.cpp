@@ -0,0 +1,1065 @@
+/*
+    Copyright (C) 2013-2016 Vladimir "allejo" Jimenez
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+// A long running soak test of the plug-in against a fake server. Thousands of matches are played with players vanishing
+// between lookups, parting during eliminations, being kicked during countdowns, and admins using /gameover mid-round.
+// The run fails if any object handed out by the API isn't freed, the scoreboard grows without bound, the movement BZDB
+// variables aren't restored exactly after a match, or the number of live allocations or resident memory grows.
+//
+// Usage: soak [matches] [seed]
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The Makefile links the plug-in's source into this directory so the stand-in headers next to it are used
+#include "lastTankStanding.cpp"
+
+// Allocation tracking
+// -------------------
+
+static long liveAllocations = 0;
+
+void* operator new(size_t size)
+{
+    void *pointer = malloc(size ? size : 1);
+
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+
+    liveAllocations++;
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (pointer)
+    {
+        liveAllocations--;
+        free(pointer);
+    }
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// Fake server
+// -----------
+
+long bz_fakeLiveObjects = 0;
+std::map<std::string, std::string> bz_fakeConfigItems;
+
+namespace
+{
+    const int FAKE_PLAYER_SLOTS = 64;
+
+    struct FakePlayer
+    {
+        bool connected;
+        std::string callsign;
+        bz_eTeamType team;
+        int wins, losses;
+        float idleTime;
+    };
+
+    FakePlayer players[FAKE_PLAYER_SLOTS];
+    std::map<std::string, std::string> bzdb;
+    std::map<std::string, bz_CustomSlashCommandHandler*> slashCommands;
+
+    bz_Plugin *eventPlugin = NULL;
+    bool registeredEvents[bz_eLastEvent];
+
+    time_t fakeNow = 1000000000;
+
+    bool vanishNextLookup = false; // The next bz_getPlayerByIndex() call will act like the player just left
+    int ghostPlayer = -1;          // A player who has left but still shows up in bz_getPlayerIndexList()
+
+    bool recording = false;
+    int savedReplays = 0;
+    int phaseNotifications = 0;
+    int lastNotifiedPhase = -1;
+
+    int matchNumber = 0;
+    int callsignCounter = 0;
+}
+
+// Use the fake clock for the plug-in's time stamps so a match doesn't take minutes to play
+time_t time(time_t *timer) __THROW
+{
+    if (timer)
+    {
+        *timer = fakeNow;
+    }
+
+    return fakeNow;
+}
+
+static void soakCheck(bool condition, const char* fmt, ...)
+{
+    if (condition)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+
+    fprintf(stderr, "FAILED (match %d): ", matchNumber);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+
+    va_end(args);
+    exit(1);
+}
+
+static void dispatch(bz_EventData &eventData)
+{
+    if (eventPlugin && registeredEvents[eventData.eventType])
+    {
+        eventPlugin->Event(&eventData);
+    }
+}
+
+static void setBZDB(const char* variable, const std::string &value)
+{
+    bzdb[variable] = value;
+
+    bz_BZDBChangeData_V1 changeData(variable, value);
+    dispatch(changeData);
+}
+
+bool bz_Plugin::Register(bz_eEventType eventType)
+{
+    eventPlugin = this;
+    registeredEvents[eventType] = true;
+    return true;
+}
+
+bool bz_Plugin::Remove(bz_eEventType eventType)
+{
+    registeredEvents[eventType] = false;
+    return true;
+}
+
+void bz_Plugin::Flush()
+{
+    for (int i = 0; i < bz_eLastEvent; i++)
+    {
+        registeredEvents[i] = false;
+    }
+}
+
+bz_APIIntList* bz_getPlayerIndexList(void)
+{
+    bz_APIIntList *list = new bz_APIIntList();
+
+    for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+    {
+        if (players[i].connected || i == ghostPlayer)
+        {
+            list->push_back(i);
+        }
+    }
+
+    return list;
+}
+
+bz_BasePlayerRecord* bz_getPlayerByIndex(int playerID)
+{
+    if (vanishNextLookup)
+    {
+        vanishNextLookup = false;
+        return NULL;
+    }
+
+    if (playerID < 0 || playerID >= FAKE_PLAYER_SLOTS || !players[playerID].connected)
+    {
+        return NULL;
+    }
+
+    bz_BasePlayerRecord *record = new bz_BasePlayerRecord();
+
+    record->playerID = playerID;
+    record->callsign = players[playerID].callsign;
+    record->team     = players[playerID].team;
+    record->wins     = players[playerID].wins;
+    record->losses   = players[playerID].losses;
+
+    return record;
+}
+
+static bool isConnected(int playerID)
+{
+    return playerID >= 0 && playerID < FAKE_PLAYER_SLOTS && players[playerID].connected;
+}
+
+const char* bz_getPlayerCallsign(int playerID)
+{
+    return isConnected(playerID) ? players[playerID].callsign.c_str() : NULL;
+}
+
+bz_eTeamType bz_getPlayerTeam(int playerID)
+{
+    return isConnected(playerID) ? players[playerID].team : eNoTeam;
+}
+
+int bz_getPlayerWins(int playerID)
+{
+    return isConnected(playerID) ? players[playerID].wins : -1;
+}
+
+int bz_getPlayerLosses(int playerID)
+{
+    return isConnected(playerID) ? players[playerID].losses : -1;
+}
+
+bool bz_setPlayerWins(int playerID, int wins)
+{
+    if (!isConnected(playerID))
+    {
+        return false;
+    }
+
+    players[playerID].wins = wins;
+    return true;
+}
+
+bool bz_setPlayerLosses(int playerID, int losses)
+{
+    if (!isConnected(playerID))
+    {
+        return false;
+    }
+
+    players[playerID].losses = losses;
+    return true;
+}
+
+bool bz_hasPerm(int playerID, const char* /*perm*/)
+{
+    return isConnected(playerID);
+}
+
+float bz_getIdleTime(int playerID)
+{
+    return isConnected(playerID) ? players[playerID].idleTime : 0;
+}
+
+bool bz_sendTextMessage(int /*from*/, int /*to*/, const char* /*message*/)
+{
+    return true;
+}
+
+bool bz_sendTextMessagef(int /*from*/, int /*to*/, const char* /*fmt*/, ...)
+{
+    return true;
+}
+
+void bz_debugMessage(int /*level*/, const char* /*message*/)
+{
+}
+
+void bz_debugMessagef(int /*level*/, const char* /*fmt*/, ...)
+{
+}
+
+bool bz_BZDBItemExists(const char* variable)
+{
+    return bzdb.count(variable) > 0;
+}
+
+double bz_getBZDBDouble(const char* variable)
+{
+    return bz_BZDBItemExists(variable) ? atof(bzdb[variable].c_str()) : 0;
+}
+
+bz_ApiString bz_getBZDBString(const char* variable)
+{
+    return bz_BZDBItemExists(variable) ? bzdb[variable] : "";
+}
+
+bool bz_getBZDBBool(const char* variable)
+{
+    return bz_getBZDBDouble(variable) != 0;
+}
+
+int bz_getBZDBInt(const char* variable)
+{
+    return (int)bz_getBZDBDouble(variable);
+}
+
+// BZFS stores every BZDB value as a string and formats doubles with six decimal places, so we do too
+bool bz_updateBZDBDouble(const char* variable, double val, int /*perms*/, bool /*persistent*/)
+{
+    char value[64];
+    snprintf(value, sizeof(value), "%f", val);
+
+    setBZDB(variable, value);
+    return true;
+}
+
+bool bz_updateBZDBString(const char* variable, const char* val, int /*perms*/, bool /*persistent*/)
+{
+    setBZDB(variable, val);
+    return true;
+}
+
+bool bz_updateBZDBBool(const char* variable, bool val, int /*perms*/, bool /*persistent*/)
+{
+    setBZDB(variable, val ? "1" : "0");
+    return true;
+}
+
+bool bz_updateBZDBInt(const char* variable, int val, int /*perms*/, bool /*persistent*/)
+{
+    setBZDB(variable, std::to_string(val));
+    return true;
+}
+
+bool bz_registerCustomSlashCommand(const char* command, bz_CustomSlashCommandHandler *handler)
+{
+    slashCommands[command] = handler;
+    return true;
+}
+
+bool bz_removeCustomSlashCommand(const char* command)
+{
+    return slashCommands.erase(command) > 0;
+}
+
+bz_eGameType bz_getGameType(void)
+{
+    return eFFAGame;
+}
+
+int bz_getTeamPlayerLimit(bz_eTeamType /*team*/)
+{
+    return 0;
+}
+
+bool bz_isTimeManualStart(void)
+{
+    return false;
+}
+
+void bz_getLocaltime(bz_Time *ts)
+{
+    struct tm now;
+    gmtime_r(&fakeNow, &now);
+
+    ts->year   = now.tm_year + 1900;
+    ts->month  = now.tm_mon + 1;
+    ts->day    = now.tm_mday;
+    ts->hour   = now.tm_hour;
+    ts->minute = now.tm_min;
+    ts->second = now.tm_sec;
+}
+
+int bz_callPluginGenericCallback(const char* plugin, const char* name, void* data)
+{
+    if (std::string(plugin) == "soakWatcher" && std::string(name) == "ltsPhaseChange")
+    {
+        phaseNotifications++;
+        lastNotifiedPhase = *(int*)data;
+        return 1;
+    }
+
+    return 0;
+}
+
+bool bz_startRecBuf(void)
+{
+    recording = true;
+    return true;
+}
+
+bool bz_stopRecBuf(void)
+{
+    recording = false;
+    return true;
+}
+
+bool bz_saveRecBuf(const char* /*filename*/, int /*seconds*/)
+{
+    savedReplays++;
+    return recording;
+}
+
+const char* bztk_pluginName(void)
+{
+    return "Last Tank Standing";
+}
+
+int bztk_getPlayerCount(void)
+{
+    int count = 0;
+
+    for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+    {
+        if (players[i].connected && players[i].team != eObservers)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void bztk_foreachPlayer(void (*function)(int))
+{
+    for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+    {
+        if (players[i].connected)
+        {
+            function(i);
+        }
+    }
+}
+
+bool bztk_changeTeam(int playerID, bz_eTeamType team)
+{
+    if (!isConnected(playerID))
+    {
+        return false;
+    }
+
+    players[playerID].team = team;
+    return true;
+}
+
+int bztk_registerCustomIntBZDB(const char* variable, int value, int perms, bool persistent)
+{
+    if (!bz_BZDBItemExists(variable))
+    {
+        bz_updateBZDBInt(variable, value, perms, persistent);
+    }
+
+    return bz_getBZDBInt(variable);
+}
+
+double bztk_registerCustomDoubleBZDB(const char* variable, double value, int perms, bool persistent)
+{
+    if (!bz_BZDBItemExists(variable))
+    {
+        bz_updateBZDBDouble(variable, value, perms, persistent);
+    }
+
+    return bz_getBZDBDouble(variable);
+}
+
+bool bztk_registerCustomBoolBZDB(const char* variable, bool value, int perms, bool persistent)
+{
+    if (!bz_BZDBItemExists(variable))
+    {
+        bz_updateBZDBBool(variable, value, perms, persistent);
+    }
+
+    return bz_getBZDBBool(variable);
+}
+
+// Simulated players
+// -----------------
+
+namespace
+{
+    // Values with more precision than BZFS' "%f" formatting keeps, so a lossy restore is caught
+    const char* MOVEMENT_VARIABLES[] = { "_gravity", "_jumpVelocity", "_reloadTime", "_tankAngVel", "_tankSpeed" };
+    const char* MOVEMENT_VALUES[]    = { "-9.80665", "19.0", "3.5", "0.7853981633974483", "25.0000001" };
+
+    std::mt19937 rng;
+    lastTankStanding *lts = NULL;
+    int camperID = -1;
+
+    int randomInt(int max)
+    {
+        return std::uniform_int_distribution<int>(0, max - 1)(rng);
+    }
+
+    bool chance(double probability)
+    {
+        return std::uniform_real_distribution<double>(0, 1)(rng) < probability;
+    }
+
+    void checkAPIObjectsFreed(const char* when)
+    {
+        soakCheck(bz_fakeLiveObjects == 0, "%ld API objects were not freed after %s", bz_fakeLiveObjects, when);
+    }
+
+    bool runCommand(int playerID, const char* command, const char* param = NULL)
+    {
+        soakCheck(slashCommands.count(command) > 0, "/%s is not registered", command);
+
+        bz_APIStringList params;
+
+        if (param)
+        {
+            params.push_back(param);
+        }
+
+        bool handled = slashCommands[command]->SlashCommand(playerID, command, "", &params);
+        checkAPIObjectsFreed(command);
+
+        return handled;
+    }
+
+    int connectedCount(void)
+    {
+        int count = 0;
+
+        for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+        {
+            count += players[i].connected;
+        }
+
+        return count;
+    }
+
+    int randomPlayer(bool playingOnly)
+    {
+        std::vector<int> candidates;
+
+        for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+        {
+            if (players[i].connected && (!playingOnly || players[i].team != eObservers))
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        return candidates.empty() ? -1 : candidates[randomInt((int)candidates.size())];
+    }
+
+    void connectPlayer(void)
+    {
+        for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+        {
+            if (players[i].connected || i == ghostPlayer)
+            {
+                continue;
+            }
+
+            FakePlayer &player = players[i];
+
+            player.connected = true;
+            player.callsign  = "tank" + std::to_string(callsignCounter++ % 1000);
+            player.team      = eRogueTeam;
+            player.wins      = player.losses = 0;
+            player.idleTime  = 0;
+
+            bz_GetAutoTeamEventData_V1 autoTeamData;
+            autoTeamData.playerID = i;
+            autoTeamData.callsign = player.callsign;
+            autoTeamData.team = eRogueTeam;
+            dispatch(autoTeamData);
+
+            player.team = autoTeamData.team;
+
+            bz_PlayerJoinPartEventData_V1 joinData(bz_ePlayerJoinEvent);
+            joinData.playerID = i;
+            dispatch(joinData);
+
+            checkAPIObjectsFreed("a join");
+            return;
+        }
+    }
+
+    void disconnectPlayer(int playerID)
+    {
+        if (!isConnected(playerID))
+        {
+            return;
+        }
+
+        {
+            bz_BasePlayerRecord record;
+            record.playerID = playerID;
+            record.callsign = players[playerID].callsign;
+            record.team     = players[playerID].team;
+
+            bz_PlayerJoinPartEventData_V1 partData(bz_ePlayerPartEvent);
+            partData.playerID = playerID;
+            partData.record = &record;
+            dispatch(partData);
+        }
+
+        players[playerID].connected = false;
+
+        if (playerID == camperID)
+        {
+            camperID = -1;
+        }
+
+        checkAPIObjectsFreed("a part");
+    }
+
+    void kickPlayer(int playerID)
+    {
+        bz_KickEventData_V1 kickData;
+        kickData.kickerID = BZ_SERVER;
+        kickData.kickedID = playerID;
+        dispatch(kickData);
+
+        disconnectPlayer(playerID);
+    }
+
+    // Advance the clock by a second, change some scores, move the tanks around, and let the server tick
+    void tick(void)
+    {
+        fakeNow++;
+
+        int scorer = randomPlayer(true);
+
+        if (scorer >= 0 && lts->isGameInProgress)
+        {
+            (chance(0.5) ? players[scorer].wins : players[scorer].losses) += 1 + randomInt(2);
+        }
+
+        for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+        {
+            if (!players[i].connected || players[i].team == eObservers)
+            {
+                continue;
+            }
+
+            // Tanks drive in circles, except for the one camper in the match
+            float angle = (i == camperID) ? 0 : (float)(fakeNow % 628) * 0.1f + i;
+
+            bz_PlayerUpdateEventData_V1 updateData;
+            updateData.playerID = i;
+            updateData.state.pos[0] = 50 * cosf(angle) + i;
+            updateData.state.pos[1] = 50 * sinf(angle);
+            updateData.state.pos[2] = 0;
+            dispatch(updateData);
+        }
+
+        bz_TickEventData_V1 tickData;
+        dispatch(tickData);
+
+        ghostPlayer = -1;
+        vanishNextLookup = false;
+
+        checkAPIObjectsFreed("a tick");
+    }
+
+    void checkScoreboard(int participants)
+    {
+        soakCheck((int)lts->eliminations.size() <= participants, "%d eliminations recorded for %d players", (int)lts->eliminations.size(), participants);
+
+        for (size_t i = 0; i < lts->eliminations.size(); i++)
+        {
+            for (size_t j = i + 1; j < lts->eliminations.size(); j++)
+            {
+                soakCheck(lts->eliminations[i].playerID != lts->eliminations[j].playerID || lts->eliminations[i].callsign != lts->eliminations[j].callsign,
+                          "%s was eliminated twice", lts->eliminations[i].callsign.c_str());
+            }
+        }
+    }
+
+    // Find out why a player was eliminated from the current match, or -1 if they're still playing
+    int eliminationReason(int playerID)
+    {
+        for (auto &player : lts->eliminations)
+        {
+            if (player.playerID == playerID && player.callsign == players[playerID].callsign)
+            {
+                return player.reason;
+            }
+        }
+
+        return -1;
+    }
+
+    // The camper should have been warned and then moved to the observers once the camp time and the warning are over
+    void checkCamperEliminated(void)
+    {
+        soakCheck(players[camperID].team == eObservers, "%s was not moved to the observers for camping", players[camperID].callsign.c_str());
+        soakCheck(eliminationReason(camperID) == lastTankStanding::eIdleTime, "%s was not eliminated for camping", players[camperID].callsign.c_str());
+    }
+
+    void checkNoMatch(void)
+    {
+        soakCheck(lts->matchPhase == lastTankStanding::eNoMatch, "the match phase is %d instead of no match", lts->matchPhase);
+        soakCheck(!lts->isGameInProgress && !lts->isCountdownInProgress, "a match is still running");
+        soakCheck(!lts->isMovementDisabled, "movement is still disabled");
+        soakCheck(!recording, "the recording buffer was not stopped");
+        soakCheck(lts->eliminations.empty(), "%d eliminations were kept after the match", (int)lts->eliminations.size());
+
+        for (int i = 0; i < 5; i++)
+        {
+            soakCheck(bzdb[MOVEMENT_VARIABLES[i]] == MOVEMENT_VALUES[i], "%s is '%s' instead of '%s'",
+                      MOVEMENT_VARIABLES[i], bzdb[MOVEMENT_VARIABLES[i]].c_str(), MOVEMENT_VALUES[i]);
+        }
+
+        for (auto &playerID : lts->matchQueue)
+        {
+            soakCheck(isConnected(playerID), "player %d left but is still queued", playerID);
+        }
+
+        checkAPIObjectsFreed("a match");
+    }
+
+    // Remove the score timeline saved next to the replay so the soak test doesn't fill up the disk
+    int removeTimeline(void)
+    {
+        std::string fileName = bz_fakeConfigItems["RECORD_DIR"] + "/" +
+                               lts->replayFileName.substr(0, lts->replayFileName.rfind(".rec")) + ".timeline";
+
+        return (remove(fileName.c_str()) == 0) ? 1 : 0;
+    }
+
+    // Play a match from /start until it's over, injecting faults along the way
+    int playMatch(void)
+    {
+        matchNumber++;
+
+        bool autoCycle = (matchNumber % 10 == 0);
+        setBZDB("_ltsAutoCycle", autoCycle ? "1" : "0");
+
+        // Churn some of the players and put everyone back on a team
+        while (connectedCount() > 3 && chance(0.3))
+        {
+            disconnectPlayer(randomPlayer(false));
+        }
+
+        int targetPlayers = 3 + randomInt(12);
+
+        while (connectedCount() < targetPlayers)
+        {
+            connectPlayer();
+        }
+
+        for (int i = 0; i < FAKE_PLAYER_SLOTS; i++)
+        {
+            players[i].team = eRogueTeam;
+            players[i].idleTime = 0;
+        }
+
+        camperID = chance(0.2) ? randomPlayer(true) : -1;
+
+        runCommand(randomPlayer(false), "start", chance(0.5) ? "15" : NULL);
+        soakCheck(lts->matchPhase == lastTankStanding::eCountdown, "/start did not start a countdown");
+
+        int participants = 0;
+        int ticks = 0;
+        int gameTicks = 0;
+        int campDeadline = -1;
+
+        while (lts->isCountdownInProgress || lts->isGameInProgress)
+        {
+            soakCheck(++ticks < 20000, "the match never ended");
+
+            if (lts->isCountdownInProgress)
+            {
+                // Kicks and parts during the countdown
+                if (chance(0.03))
+                {
+                    kickPlayer(randomPlayer(true));
+                }
+
+                if (chance(0.02))
+                {
+                    disconnectPlayer(randomPlayer(true));
+                }
+            }
+            else
+            {
+                if (participants == 0)
+                {
+                    participants = bztk_getPlayerCount();
+                    campDeadline = gameTicks + lts->campTime + CAMP_WARNING_TIME + 2;
+                }
+
+                // Faults timed for the next elimination round
+                if (lts->getTimeToElimination() <= 1)
+                {
+                    if (chance(0.3))
+                    {
+                        disconnectPlayer(randomPlayer(true));
+                    }
+
+                    if (chance(0.2))
+                    {
+                        vanishNextLookup = true;
+                    }
+
+                    if (chance(0.1))
+                    {
+                        int playerID = randomPlayer(true);
+
+                        disconnectPlayer(playerID);
+                        ghostPlayer = playerID;
+                    }
+                }
+
+                // Faults that can happen at any time
+                if (chance(0.002))
+                {
+                    runCommand(randomPlayer(false), "gameover");
+                    break;
+                }
+
+                if (chance(0.005))
+                {
+                    int playerID = randomPlayer(true);
+
+                    if (playerID >= 0 && playerID != camperID)
+                    {
+                        players[playerID].idleTime = 1000;
+                    }
+                }
+
+                if (chance(0.005))
+                {
+                    connectPlayer();
+                }
+
+                if (chance(0.003))
+                {
+                    disconnectPlayer(randomPlayer(false));
+                }
+
+                if (chance(0.005))
+                {
+                    kickPlayer(randomPlayer(true));
+                }
+
+                if (chance(0.01))
+                {
+                    int playerID = randomPlayer(true);
+
+                    bz_PlayerDieEventData_V1 dieData;
+                    dieData.playerID = playerID;
+                    dispatch(dieData);
+
+                    bz_PlayerSpawnEventData_V1 spawnData;
+                    spawnData.playerID = playerID;
+                    dispatch(spawnData);
+
+                    // Respawning starts the camp time over
+                    if (playerID == camperID)
+                    {
+                        campDeadline = gameTicks + lts->campTime + CAMP_WARNING_TIME + 2;
+                    }
+                }
+
+                if (chance(0.005))
+                {
+                    bz_PlayerPausedEventData_V1 pauseData;
+                    pauseData.playerID = randomPlayer(true);
+                    pauseData.pause = true;
+                    dispatch(pauseData);
+                }
+
+                if (chance(0.005))
+                {
+                    runCommand(randomPlayer(false), "queue");
+                }
+            }
+
+            tick();
+
+            if (lts->isGameInProgress)
+            {
+                checkScoreboard(participants);
+                soakCheck(lts->getTimeToElimination() > 0, "the elimination round did not advance");
+
+                // A camper who has a low score may be eliminated for it before the camp time is over
+                if (camperID >= 0 && eliminationReason(camperID) != -1 && eliminationReason(camperID) != lastTankStanding::eIdleTime)
+                {
+                    camperID = -1;
+                }
+
+                if (++gameTicks == campDeadline && camperID >= 0)
+                {
+                    checkCamperEliminated();
+                }
+            }
+            else if (participants > 0)
+            {
+                // The match is over; with enough players queued an auto cycled match goes straight into the next countdown
+                break;
+            }
+        }
+
+        int timelines = removeTimeline();
+
+        // An auto cycled match moves on to the intermission or the next countdown, which an admin can still stop
+        if (autoCycle && lts->matchPhase != lastTankStanding::eNoMatch)
+        {
+            soakCheck(lts->matchPhase == lastTankStanding::eIntermission || lts->matchPhase == lastTankStanding::eCountdown,
+                      "an auto cycled match ended in phase %d", lts->matchPhase);
+
+            tick();
+
+            if (lts->matchPhase == lastTankStanding::eCountdown)
+            {
+                runCommand(randomPlayer(false), "gameover");
+                soakCheck(lts->matchQueue.empty(), "/gameover did not clear the queue");
+            }
+            else if (lts->matchPhase == lastTankStanding::eIntermission)
+            {
+                runCommand(randomPlayer(false), "queue");
+                runCommand(randomPlayer(false), "gameover");
+                soakCheck(lts->matchQueue.empty(), "/gameover did not clear the queue during the intermission");
+            }
+        }
+
+        checkNoMatch();
+
+        return timelines;
+    }
+
+    long residentMemory(void)
+    {
+        long pages = 0, resident = 0;
+        FILE *statm = fopen("/proc/self/statm", "r");
+
+        if (!statm)
+        {
+            return 0;
+        }
+
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+
+        fclose(statm);
+
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int matches = (argc > 1) ? atoi(argv[1]) : 3000;
+    rng.seed((argc > 2) ? atoi(argv[2]) : 1);
+
+    char recordDirectory[] = "/tmp/lts-soak-XXXXXX";
+    soakCheck(mkdtemp(recordDirectory) != NULL, "could not create a directory for the replays");
+
+    bz_fakeConfigItems["RECORD_MATCHES"]  = "true";
+    bz_fakeConfigItems["RECORD_DIR"]      = recordDirectory;
+    bz_fakeConfigItems["GAME_START_PERM"] = "vote";
+    bz_fakeConfigItems["GAME_END_PERM"]   = "endgame";
+
+    // Values set with -setforced before the plug-in is loaded; the camp time, queue size, and timeline
+    // interval are out of range on purpose
+    for (int i = 0; i < 5; i++)
+    {
+        bzdb[MOVEMENT_VARIABLES[i]] = MOVEMENT_VALUES[i];
+    }
+
+    bzdb["_ltsKickTime"] = "45";
+    bzdb["_ltsCampTime"] = "90";
+    bzdb["_ltsIntermission"] = "5";
+    bzdb["_ltsQueueSize"] = "1";
+    bzdb["_ltsTimelineInterval"] = "0";
+
+    bz_Plugin *plugin = bz_GetPlugin();
+    lts = dynamic_cast<lastTankStanding*>(plugin);
+    lts->Init("soak.cfg");
+
+    soakCheck(lts->campTime == 30, "an out of range _ltsCampTime was not clamped (%d)", lts->campTime);
+    soakCheck(lts->queueSize == 4, "an out of range _ltsQueueSize was not clamped (%d)", lts->queueSize);
+    soakCheck(lts->timelineInterval == 5, "an out of range _ltsTimelineInterval was not clamped (%d)", lts->timelineInterval);
+
+    int subscriber = lts->GeneralCallback("subscribePhaseChange", (void*)"soakWatcher");
+    soakCheck(subscriber == 1, "could not subscribe to phase changes");
+
+    const int warmup = std::min(200, matches / 4);
+    long baselineAllocations = 0, baselineMemory = 0;
+    int timelines = 0;
+
+    for (int i = 0; i < matches; i++)
+    {
+        timelines += playMatch();
+
+        if (i + 1 == warmup)
+        {
+            baselineAllocations = liveAllocations;
+            baselineMemory = residentMemory();
+        }
+    }
+
+    long finalAllocations = liveAllocations;
+    long finalMemory = residentMemory();
+
+    // Containers may grow to fit the largest match seen, but nothing should grow with the number of matches played
+    soakCheck(finalAllocations <= baselineAllocations + 32, "live allocations grew from %ld to %ld", baselineAllocations, finalAllocations);
+    soakCheck(finalMemory <= baselineMemory + 2 * 1024 * 1024, "resident memory grew from %ld to %ld bytes", baselineMemory, finalMemory);
+    soakCheck(timelines > 0 && savedReplays > 0, "no replays or score timelines were saved");
+
+    // Unloading the plug-in in the middle of a match must end it properly
+    runCommand(randomPlayer(false), "start");
+
+    while (lts->isCountdownInProgress)
+    {
+        tick();
+    }
+
+    tick();
+    soakCheck(lastNotifiedPhase == lastTankStanding::eInProgress, "subscribers weren't told the match started");
+
+    lts->Cleanup();
+
+    soakCheck(lastNotifiedPhase == lastTankStanding::eNoMatch, "subscribers weren't told the match ended on unload");
+    soakCheck(slashCommands.empty(), "slash commands are still registered after unloading");
+    timelines += removeTimeline();
+    checkNoMatch();
+
+    bz_FreePlugin(plugin);
+    rmdir(recordDirectory);
+
+    printf("%d matches played, %d replays and %d score timelines saved, %d phase changes\n", matchNumber, savedReplays, timelines, phaseNotifications);
+    printf("live allocations: %ld after warmup, %ld at the end; resident memory: %ld KiB after warmup, %ld KiB at the end\n",
+           baselineAllocations, finalAllocations, baselineMemory / 1024, finalMemory / 1024);
+
+    return 0;
+}